@@ -0,0 +1,33 @@
+#pragma once
+/******************************************************************************
+ * board_pool.hpp  —  bounded arena of reusable Matrix boards
+ *
+ * Boards are built on first demand, up to `capacity`, and recycled after
+ * that: release() returns a board to the free list and acquire() hands it
+ * out again after Matrix::reset().  A recycled board keeps the buffers of
+ * the largest game it has held, so once every board has served its
+ * largest size, create / close stop constructing Matrix storage.
+ ******************************************************************************/
+
+#include "matrix.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class BoardPool
+{
+public:
+    explicit BoardPool(std::size_t capacity);
+
+    /// nullptr when `capacity` boards are already in use.
+    Matrix* acquire(int stickCount);
+    void release(Matrix* board);
+
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    std::size_t capacity_;
+    std::vector<std::unique_ptr<Matrix>> boards_;  ///< owns every board built
+    std::vector<Matrix*> free_;                    ///< LIFO free list
+    std::mutex mutex_;
+};
@@ -19,6 +19,7 @@
 #include <string>
 #include <utility>
 #include "stick.hpp" // Include the new stick header
+#include "trace.hpp"
 
 class Matrix
 {
@@ -40,10 +41,45 @@ public:
     /// Helper that returns EE / MM / ME for a pair of Locations.
     static Connection connectionType(Location lhs, Location rhs);
 
+    /* ────────────────────────────────────────────────────────────────── */
+    /* Non-interactive move API                                         */
+    /* ────────────────────────────────────────────────────────────────── */
+    /// A single connection; indices are 0-based node numbers.
+    struct Move {
+        int  first;
+        int  second;
+        char sign;    ///< '+' or '-'
+    };
+
+    /// Outcome of applyMove(); anything but Ok leaves the board untouched.
+    enum class MoveStatus {
+        Ok,
+        OutOfRange,   ///< node index outside [0, size)
+        BadSign,      ///< sign is neither '+' nor '-'
+        Occupied,     ///< target cell is not writable
+        SignMismatch  ///< sign contradicts an existing '+' / '-' bound
+    };
+
     /* ────────────────────────────────────────────────────────────────── */
     /* Construction & user interaction                                  */
     /* ────────────────────────────────────────────────────────────────── */
-    Matrix();
+    Matrix();                          ///< prompts on std::cin for N
+    explicit Matrix(int stickCount);   ///< no console interaction
+    void reset(int stickCount);        ///< back to the empty scaffold
+
+    MoveStatus applyMove(int first, int second, char sign);
+    bool undo();                       ///< false if there is nothing to undo
+    /// Fills `out` (cleared first) so callers can reuse one buffer.
+    void legalMoves(std::vector<Move>& out) const;
+
+    int  size() const { return matrixSize_; }
+    int  stickCount() const { return matrixSize_ / 3; }
+    unsigned lastEliminated() const { return num_connecs_elim_; }
+    const std::vector<Move>& history() const { return history_; }
+    /// Only rows / columns [0, size()) are meaningful; a reused board may
+    /// keep larger buffers from an earlier session.
+    const std::vector<std::vector<std::string>>& cells() const { return data_; }
+
     void updateMatrix();
     void print() const;
     void checkSignBounding(char userSign,
@@ -62,6 +98,8 @@ private:
     std::vector<std::vector<std::string>> data_;
     unsigned num_connecs_elim_ = 0;
     std::vector<Stick> sticks_; // Add a vector of sticks
+    std::vector<Move> history_;  ///< applied moves, replayed by undo()
+    Trace::Context trace_;       ///< board id / move / rule for tracing
 
     /* ────────────────────────────────────────────────────────────────── */
     /* Console / input helpers                                          */
@@ -76,8 +114,12 @@ private:
     /* Low-level cell manipulation                                      */
     /* ────────────────────────────────────────────────────────────────── */
     void writeCell(int row, int col, const std::string& value);
+    void traceCell(int row, int col,
+                   const std::string& from, const std::string& to);
     void applyDirectedSign(int from, int to, char sign);
     bool isWritable(int from, int to) const;
+    bool matchesSignBound(char sign, int from, int to) const;
+    void propagateMove(int first, int second, char sign);
 
     /* ────────────────────────────────────────────────────────────────── */
     /* Stick / node helpers                                             */
@@ -98,6 +140,7 @@ private:
     void applyConnectionLimit(Node& node1, Node& node2);
     // --- New General Helper Functions ---
     void checkAndEnforceTransitiveConnections(int source_node_idx, int newly_connected_node_idx);
-    std::vector<Node*> getNodeConnections(int node_idx);
+    void getNodeConnections(int node_idx, std::vector<Node*>& out);
+    std::vector<Node*> neighbours_;  ///< scratch for the transitive rule
     void enforceConnection(int stick1_id, int stick2_id, Connection type);
 };
\ No newline at end of file
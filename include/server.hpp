@@ -0,0 +1,58 @@
+#pragma once
+/******************************************************************************
+ * server.hpp  —  long-running stick-bomb session server
+ *
+ * Serves many concurrent Matrix sessions over a local Unix socket so that
+ * design tools do not pay process start-up and move replay per query.
+ *
+ * Protocol: one request per line, one JSON object per response line.
+ * Node numbers are 1-based, exactly as in the interactive prompts.
+ *
+ *   create N              → {"ok":true,"session":ID,"size":3N}
+ *   move ID A B S         → {"ok":true,"eliminated":k,"full":false}
+ *   undo ID               → {"ok":true,"moves":count}
+ *   legal ID              → {"ok":true,"moves":[[A,B,"+"],...]}
+ *   snapshot ID           → {"ok":true,"size":n,"history":[...],"rows":[...]}
+ *   close ID              → {"ok":true}
+ *
+ * Failures answer {"ok":false,"error":"..."}.  Sessions belong to the
+ * connection that created them and are released when it disconnects.
+ *
+ * One thread runs the poll() event loop; complete lines are handed to a
+ * worker pool.  Lines from a single connection are processed in order.
+ * Sockets are non-blocking and only the event loop sends, so a client that
+ * stops reading its replies stalls its own requests, not a worker.
+ ******************************************************************************/
+
+#include "board_pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+class SessionServer
+{
+public:
+    struct Options {
+        std::string socketPath{"/tmp/stickbomb.sock"};
+        unsigned    workers{4};
+        std::size_t boards{256};   ///< max live sessions; built on demand
+        int         maxSticks{64}; ///< largest N accepted by "create"
+    };
+
+    explicit SessionServer(const Options& opts);
+
+    /// Blocks until stop() is called; returns a process exit code.
+    int run();
+    void stop() { stop_.store(true); }
+
+private:
+    struct Connection;                 ///< defined in server.cc
+
+    void drain(Connection& conn);      ///< run queued lines in order
+    void handleLine(Connection& conn, const char* line, std::string& out);
+
+    Options opts_;
+    BoardPool pool_;
+    std::atomic<bool> stop_{false};
+    std::atomic<int>  nextSession_{1};
+};
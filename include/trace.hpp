@@ -0,0 +1,133 @@
+#pragma once
+/******************************************************************************
+ * trace.hpp  —  optional propagation trace for the rule engine
+ *
+ * When enabled, every cell the rule engine changes is recorded as a fixed
+ * 20-byte Trace::Event: board, per-board sequence, move number, cell, old
+ * and new value, and the rule that wrote it.
+ *
+ * Each recording thread owns a single-producer ring; a background thread
+ * drains all rings into a binary file (see trace_decode.cc for the
+ * reader).  When tracing is off the hot path costs one relaxed load.
+ * A ring that passes half full wakes the writer early.  If it fills
+ * anyway, Lossless mode (the default) makes the engine yield until the
+ * writer catches up; Lossy mode drops the event instead and counts it
+ * in the header's `dropped` field.  stop() reports both on stderr.
+ *
+ * File layout (host byte order):
+ *   Header            magic "SBTRACE1", version, eventSize, dropped
+ *   Event × count     until end of file
+ ******************************************************************************/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Trace {
+
+/// Rule engine entry point that caused a write.
+enum class Rule : std::uint8_t {
+    None,               ///< outside any rule (should not appear)
+    DirectedSign,       ///< Matrix::applyDirectedSign
+    EdgeTypeRules,      ///< Matrix::applyEdgeTypeRules
+    EnforceConnection,  ///< Matrix::enforceConnection
+    ConnectionLimit     ///< Matrix::applyConnectionLimit
+};
+
+/// Compact encoding of a matrix cell string.
+enum class Cell : std::uint8_t {
+    Empty,      ///< "0"
+    Pos,        ///< "1"
+    Neg,        ///< "-1"
+    Strong,     ///< "2"
+    Blocked,    ///< "x"
+    BoundPos,   ///< "+"
+    BoundNeg,   ///< "-"
+    Unknown
+};
+
+enum Flags : std::uint8_t {
+    Replay = 1   ///< emitted while Matrix::undo() replays history
+};
+
+struct Event {
+    std::uint32_t board;   ///< Matrix instance id
+    std::uint32_t seq;     ///< per-board order; sort key across threads
+    std::uint32_t move;    ///< 1-based move number on that board
+    std::uint16_t row;
+    std::uint16_t col;
+    Cell          from;
+    Cell          to;
+    Rule          rule;
+    std::uint8_t  flags;
+};
+static_assert(sizeof(Event) == 20, "Trace::Event is a wire format");
+
+struct Header {
+    char          magic[8];   ///< "SBTRACE1"
+    std::uint32_t version;
+    std::uint32_t eventSize;
+    std::uint64_t dropped;    ///< events lost to full rings
+};
+static_assert(sizeof(Header) == 24, "Trace::Header is a wire format");
+
+constexpr std::uint32_t kVersion = 1;
+
+enum class Mode : std::uint8_t {
+    Lossless,   ///< a full ring stalls the recording thread
+    Lossy       ///< a full ring drops the event
+};
+
+/// Largest ring start() will build: 20 MiB of events per thread.
+constexpr std::size_t kMaxRingCapacity = 1u << 20;
+
+struct Options {
+    Mode        mode{Mode::Lossless};
+    std::size_t ringCapacity{1u << 16};  ///< events per thread; clamped to
+                                         ///< [1024, kMaxRingCapacity], then
+                                         ///< rounded up to a power of two
+};
+
+/// Per-board recording state, owned by each Matrix.
+struct Context {
+    std::uint32_t board{0};
+    std::uint32_t seq{0};
+    std::uint32_t move{0};
+    Rule          rule{Rule::None};
+    std::uint8_t  flags{0};
+};
+
+/// Tags the writes made inside a rule; restores the outer rule on exit.
+class RuleScope {
+public:
+    RuleScope(Context& ctx, Rule rule) : ctx_(ctx), saved_(ctx.rule) { ctx.rule = rule; }
+    ~RuleScope() { ctx_.rule = saved_; }
+    RuleScope(const RuleScope&) = delete;
+    RuleScope& operator=(const RuleScope&) = delete;
+
+private:
+    Context& ctx_;
+    Rule     saved_;
+};
+
+/* ────────────────────────────────────────────────────────────────── */
+/* Session control                                                  */
+/* ────────────────────────────────────────────────────────────────── */
+/// false if the file can't open.  May be called again after stop(); rings
+/// from an earlier session keep their capacity but start out empty.
+bool start(const std::string& path, const Options& opts = Options{});
+void stop();                           ///< flush, close, patch header
+
+extern std::atomic<bool> g_enabled;
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+std::uint32_t nextBoardId();
+Cell encode(const std::string& cell);
+const char* decode(Cell cell);
+const char* name(Rule rule);
+
+/// Slow path; call only when enabled().
+void record(Context& ctx, int row, int col, Cell from, Cell to);
+
+} // namespace Trace
@@ -0,0 +1,38 @@
+/******************************************************************************
+ * board_pool.cc  —  implementation of the Matrix arena
+ ******************************************************************************/
+
+#include "board_pool.hpp"
+
+BoardPool::BoardPool(std::size_t capacity)
+    : capacity_(capacity)
+{
+    boards_.reserve(capacity);   // bookkeeping only; boards come on demand
+    free_.reserve(capacity);
+}
+
+Matrix* BoardPool::acquire(int stickCount)
+{
+    Matrix* board = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            board = free_.back();
+            free_.pop_back();
+        } else if (boards_.size() < capacity_) {
+            boards_.push_back(std::make_unique<Matrix>(stickCount));
+            return boards_.back().get();
+        } else {
+            return nullptr;
+        }
+    }
+    board->reset(stickCount);   // outside the lock; the board is ours now
+    return board;
+}
+
+void BoardPool::release(Matrix* board)
+{
+    if (board == nullptr) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(board);     // capacity reserved in the ctor
+}
@@ -4,13 +4,110 @@
  *  • Builds a Matrix (user is prompted for stick count).
  *  • Prints the initial scaffold.
  *  • Repeatedly asks the user for connections until the matrix is full.
+ *
+ *  `output --serve [socket-path]` instead runs the session server
+ *  (see server.hpp) until interrupted.
+ *
+ *  `output --trace FILE ...` records every rule-engine write to FILE
+ *  (see trace.hpp; read it back with trace_decode).  It never drops
+ *  events unless `--trace-lossy` is given; `--trace-ring N` sets the
+ *  per-thread ring size in events.  Flags may come in any order; anything
+ *  unrecognised prints the usage line and exits with status 2.
  ******************************************************************************/
 
 #include "matrix.hpp"
+#include "server.hpp"
+#include "trace.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+
+namespace {
+SessionServer* g_server = nullptr;
+void onSignal(int) { if (g_server) g_server->stop(); }
+
+/// Parses a ring size in events; false for junk, 0 or anything too big.
+bool parseRingSize(const char* text, std::size_t& out)
+{
+    if (*text < '0' || *text > '9') return false;   // strtoul takes "-1"
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long v = std::strtoul(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || v == 0 || v > Trace::kMaxRingCapacity)
+        return false;
+    out = v;
+    return true;
+}
+
+int usage(const std::string& why)
+{
+    std::cerr << "output: " << why << "\n"
+                 "usage: output [--trace FILE [--trace-lossy] [--trace-ring N]]"
+                 " [--serve [socket-path]]\n";
+    return 2;
+}
+}
 
-int main()
+int main(int argc, char** argv)
 {
+    const char* tracePath = nullptr;
+    Trace::Options traceOpts;
+    bool traceTuned = false;         // --trace-lossy / --trace-ring seen
+    bool serve = false;
+    SessionServer::Options serveOpts;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const std::string flag = argv[arg];
+        const bool hasValue = arg + 1 < argc && std::strncmp(argv[arg + 1], "--", 2) != 0;
+        if (flag == "--trace")
+        {
+            if (!hasValue) return usage("--trace needs a file name");
+            tracePath = argv[++arg];
+        }
+        else if (flag == "--trace-lossy")
+        {
+            traceOpts.mode = Trace::Mode::Lossy;
+            traceTuned = true;
+        }
+        else if (flag == "--trace-ring")
+        {
+            if (!hasValue || !parseRingSize(argv[arg + 1], traceOpts.ringCapacity))
+                return usage("--trace-ring expects an event count from 1 to " +
+                             std::to_string(Trace::kMaxRingCapacity));
+            ++arg;
+            traceTuned = true;
+        }
+        else if (flag == "--serve" && !serve)
+        {
+            serve = true;
+            if (hasValue) serveOpts.socketPath = argv[++arg];
+        }
+        else
+            return usage("unexpected argument '" + flag + "'");
+    }
+    if (traceTuned && tracePath == nullptr)
+        return usage("--trace-lossy and --trace-ring need --trace FILE");
+
+    if (tracePath != nullptr && !Trace::start(tracePath, traceOpts))
+    {
+        std::cerr << "Cannot open trace file " << tracePath << '\n';
+        return 1;
+    }
+
+    if (serve)
+    {
+        SessionServer server(serveOpts);
+        g_server = &server;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        const int rc = server.run();
+        Trace::stop();
+        return rc;
+    }
+
     Matrix matrix;           // user is asked for stick count in the ctor
 
     std::cout << "\nInitial matrix:\n";
@@ -26,5 +123,6 @@ int main()
     }
 
     std::cout << "\n🎉  Matrix is completely filled.  Goodbye!\n";
+    Trace::stop();
     return 0;
 }
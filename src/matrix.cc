@@ -25,11 +25,35 @@ using std::vector;
 Matrix::Matrix()
 {
     clearConsole();
-    int stickCount = promptStickCount();
+    reset(promptStickCount());
+}
+
+Matrix::Matrix(int stickCount)
+{
+    reset(stickCount);
+}
 
+void Matrix::reset(int stickCount)
+{
     matrixSize_ = stickCount * 3;
-    data_.assign(matrixSize_, vector<string>(matrixSize_, "0"));
+    num_connecs_elim_ = 0;
+    history_.clear();
+    trace_ = Trace::Context{};
+    trace_.board = Trace::nextBoardId();
+
+    /* data_ only ever grows: a pooled board keeps the rows of the largest
+       size it has held, and everything else reads [0, matrixSize_) */
+    if (static_cast<int>(data_.size()) < matrixSize_)
+        data_.resize(matrixSize_);
+    for (int r = 0; r < matrixSize_; ++r) {
+        vector<string>& row = data_[r];
+        if (static_cast<int>(row.size()) < matrixSize_)
+            row.resize(matrixSize_);
+        std::fill_n(row.begin(), matrixSize_, "0");
+    }
 
+    sticks_.clear();
+    sticks_.reserve(stickCount);
     for (int i = 0; i < stickCount; ++i) {
         sticks_.emplace_back(i);
     }
@@ -40,18 +64,85 @@ Matrix::Matrix()
 
 void Matrix::updateMatrix()
 {
-    num_connecs_elim_ = 0;
-
     const int first_idx = promptNodeIndex("Enter the first number") - 1;
     const int second_idx = promptNodeIndex("Enter the second number") - 1;
     const char userSign = promptSign();
 
-    if (!isWritable(first_idx, second_idx)) return;
+    switch (applyMove(first_idx, second_idx, userSign)) {
+    case MoveStatus::Occupied:
+        cout << "Invalid: target cell is occupied.\n";
+        return;
+    case MoveStatus::SignMismatch:
+        cout << "Invalid input: sign must match existing bound.\n";
+        return;
+    case MoveStatus::OutOfRange:
+    case MoveStatus::BadSign:
+        return; // the prompts never let these through
+    case MoveStatus::Ok:
+        break;
+    }
+
+    cout << "Number of moves eliminated: " << num_connecs_elim_;
+}
+
+Matrix::MoveStatus Matrix::applyMove(int first_idx, int second_idx, char userSign)
+{
+    num_connecs_elim_ = 0;
+
+    if (first_idx < 0 || first_idx >= matrixSize_ ||
+        second_idx < 0 || second_idx >= matrixSize_)
+        return MoveStatus::OutOfRange;
+    if (userSign != '+' && userSign != '-') return MoveStatus::BadSign;
+    if (!isWritable(first_idx, second_idx)) return MoveStatus::Occupied;
+    if (!matchesSignBound(userSign, first_idx, second_idx))
+        return MoveStatus::SignMismatch;
+
+    trace_.move = static_cast<std::uint32_t>(history_.size() + 1);
+    trace_.flags = 0;
+    propagateMove(first_idx, second_idx, userSign);
+    history_.push_back({first_idx, second_idx, userSign});
+    return MoveStatus::Ok;
+}
+
+/* The rule engine only ever moves cells towards "x", so there is no local
+   inverse of a move; undo rebuilds the board and replays the history. */
+bool Matrix::undo()
+{
+    if (history_.empty()) return false;
+
+    vector<Move> replay;
+    replay.swap(history_);
+    replay.pop_back();
+
+    const Trace::Context traced = trace_;   // same board, seq continues
+    reset(stickCount());
+    trace_ = traced;
+    trace_.flags = Trace::Replay;
+    for (std::size_t i = 0; i < replay.size(); ++i) {
+        trace_.move = static_cast<std::uint32_t>(i + 1);
+        propagateMove(replay[i].first, replay[i].second, replay[i].sign);
+    }
+    trace_.flags = 0;
+
+    history_.swap(replay);
+    num_connecs_elim_ = 0;
+    return true;
+}
 
-    bool isError{};
-    checkSignBounding(userSign, first_idx, second_idx, isError);
-    if (isError) return;
+void Matrix::legalMoves(vector<Move>& moves) const
+{
+    moves.clear();
+    for (int r = 0; r < matrixSize_; ++r) {
+        for (int c = r + 1; c < matrixSize_; ++c) {
+            const string& cell = data_[r][c];
+            if (cell == "0" || cell == "+") moves.push_back({r, c, '+'});
+            if (cell == "0" || cell == "-") moves.push_back({r, c, '-'});
+        }
+    }
+}
 
+void Matrix::propagateMove(int first_idx, int second_idx, char userSign)
+{
     Location locFirst, locSecond;
     assignLocations(first_idx, locFirst, second_idx, locSecond);
     
@@ -74,8 +165,6 @@ void Matrix::updateMatrix()
     applyEdgeTypeRules(locFirst, locSecond, first_idx, second_idx, userSign);
     applyMultiConnectionRules(first_idx, second_idx, locFirst, locSecond);
     applyConnectionLimit(node1_obj, node2_obj);
-
-    cout << "Number of moves eliminated: " << num_connecs_elim_;
 }
 
 /* ───────────────── rule engine ─────────────────────────────────────── */
@@ -83,6 +172,7 @@ void Matrix::updateMatrix()
 void Matrix::applyEdgeTypeRules(Location loc1, Location loc2,
                                 int node1_idx, int node2_idx, char userSign)
 {
+    Trace::RuleScope rule(trace_, Trace::Rule::EdgeTypeRules);
     Stick& stick1 = getStickFromNode(node1_idx);
     Stick& stick2 = getStickFromNode(node2_idx);
     
@@ -101,8 +191,12 @@ void Matrix::applyEdgeTypeRules(Location loc1, Location loc2,
             }
         }
         
-        data_[node1_idx][node2_idx] = (userSign == '+') ? "1" : "-1";
-        data_[node2_idx][node1_idx] = (userSign == '+') ? "-1" : "1";
+        const string fwd = (userSign == '+') ? "1" : "-1";
+        const string rev = (userSign == '+') ? "-1" : "1";
+        traceCell(node1_idx, node2_idx, data_[node1_idx][node2_idx], fwd);
+        traceCell(node2_idx, node1_idx, data_[node2_idx][node1_idx], rev);
+        data_[node1_idx][node2_idx] = fwd;
+        data_[node2_idx][node1_idx] = rev;
 
         if (connectionType(loc1, loc2) == Connection::ME) {
             const string usr_sign(1, userSign);
@@ -130,7 +224,8 @@ void Matrix::applyMultiConnectionRules(int node1_idx, int node2_idx, Location lo
 void Matrix::checkAndEnforceTransitiveConnections(int source_node_idx, int newly_connected_node_idx) {
     Node& source_node = getStickFromNode(source_node_idx).getNodeByIndex(source_node_idx % 3);
 
-    vector<Node*> neighbors = getNodeConnections(source_node_idx);
+    vector<Node*>& neighbors = neighbours_;
+    getNodeConnections(source_node_idx, neighbors);
 
     if (neighbors.size() >= 2) {
         for (size_t i = 0; i < neighbors.size(); ++i) {
@@ -144,6 +239,7 @@ void Matrix::checkAndEnforceTransitiveConnections(int source_node_idx, int newly
 }
 
 void Matrix::applyConnectionLimit(Node& node1, Node& node2) {
+    Trace::RuleScope rule(trace_, Trace::Rule::ConnectionLimit);
     if (node1.getConnections().size() >= 2) {
         int node_id = node1.getId();
         for (unsigned i = 0; i < matrixSize_; i++) {
@@ -166,19 +262,19 @@ void Matrix::applyConnectionLimit(Node& node1, Node& node2) {
 
 /* ───────────────── new general helpers ───────────────────────────────── */
 
-vector<Node*> Matrix::getNodeConnections(int node_idx) {
-    vector<Node*> connections;
+void Matrix::getNodeConnections(int node_idx, vector<Node*>& connections) {
+    connections.clear();
     for(int i = 0; i < matrixSize_; ++i) {
         if(data_[node_idx][i] == "1" || data_[node_idx][i] == "-1") {
             connections.push_back(&getStickFromNode(i).getNodeByIndex(i % 3));
         }
     }
-    return connections;
 }
 
 
 void Matrix::enforceConnection(int stick1_id, int stick2_id, Connection type) {
     if (stick1_id == stick2_id) return;
+    Trace::RuleScope rule(trace_, Trace::Rule::EnforceConnection);
     auto [rS, rE] = stickBlock(stick1_id * 3);
     auto [cS, cE] = stickBlock(stick2_id * 3);
 
@@ -201,6 +297,7 @@ void Matrix::writeCell(int r, int c, const string &val) {
     if (currentCell == val || currentCell == "2") return;
 
     if (currentCell == "x" && (val == "+" || val == "-")) {
+        traceCell(r, c, currentCell, val);
         currentCell = val;
         num_connecs_elim_--; 
         return;
@@ -209,6 +306,7 @@ void Matrix::writeCell(int r, int c, const string &val) {
     if (currentCell == "x") return;
 
     string originalState = currentCell;
+    traceCell(r, c, originalState, val);
     currentCell = val;
     
     if (originalState == "0") {
@@ -218,8 +316,16 @@ void Matrix::writeCell(int r, int c, const string &val) {
     }
 }
 
+/* One relaxed load when tracing is off; writes are only encoded when on. */
+void Matrix::traceCell(int r, int c, const string &from, const string &to)
+{
+    if (Trace::enabled())
+        Trace::record(trace_, r, c, Trace::encode(from), Trace::encode(to));
+}
+
 void Matrix::applyDirectedSign(int i, int j, char sign)
 {
+    Trace::RuleScope rule(trace_, Trace::Rule::DirectedSign);
     writeCell(i, j, (sign == '+') ? "1" : "-1");
     writeCell(j, i, (sign == '+') ? "-1" : "1");
 }
@@ -227,12 +333,17 @@ void Matrix::applyDirectedSign(int i, int j, char sign)
 /* ───────────────────────── HELPERS (No Changes Below) ─────────────────────────────── */
 void Matrix::checkSignBounding(char sign, int i, int j, bool &flag)
 {
-    flag = ((sign == '-' && data_[i][j] == "+") ||
-            (sign == '+' && data_[i][j] == "-"));
+    flag = !matchesSignBound(sign, i, j);
     if (flag)
         cout << "Invalid input: sign must match existing bound.\n";
 }
 
+bool Matrix::matchesSignBound(char sign, int i, int j) const
+{
+    return !((sign == '-' && data_[i][j] == "+") ||
+             (sign == '+' && data_[i][j] == "-"));
+}
+
 void Matrix::print() const
 {
     constexpr int W = 4;
@@ -324,10 +435,7 @@ char Matrix::promptSign() const
 bool Matrix::isWritable(int i, int j) const
 {
     const string &cur = data_[i][j];
-    if (cur == "0" || cur == "+" || cur == "-")
-        return true;
-    cout << "Invalid: target cell is occupied.\n";
-    return false;
+    return cur == "0" || cur == "+" || cur == "-";
 }
 
 std::pair<int, int> Matrix::stickBlock(int idx) const
@@ -387,10 +495,13 @@ Matrix::Connection Matrix::connectionType(Location a, Location b)
 
 bool Matrix::isFull() const
 {
-    for (const auto &row : data_)
-        for (const auto &cell : row)
+    for (int r = 0; r < matrixSize_; ++r)
+        for (int c = 0; c < matrixSize_; ++c)
+        {
+            const string &cell = data_[r][c];
             if (cell == "0" || cell == "+" || cell == "-")
                 return false;
+        }
     return true;
 }
 
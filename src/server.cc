@@ -0,0 +1,636 @@
+/******************************************************************************
+ * server.cc  —  implementation of the stick-bomb session server
+ ******************************************************************************/
+
+#include "server.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr std::size_t kMaxLine = 4096;       ///< longer lines drop the client
+constexpr std::size_t kMaxQueued = 64 << 10; ///< unrun input before reads pause
+constexpr std::size_t kMaxOutput = 1 << 20;  ///< unsent output before work pauses
+constexpr int kPollMs = 250;                 ///< how often stop() is noticed
+
+/* ───────────────────────── ready queue ──────────────────────────────── */
+
+/* FIFO of connections that have lines to run.  A connection is queued at
+   most once at a time (Connection::scheduled), so the ring grows with the
+   number of clients and never per request. */
+template <typename T>
+class ReadyQueue
+{
+public:
+    void push(T item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (count_ == ring_.size()) grow();
+            ring_[(head_ + count_) % ring_.size()] = std::move(item);
+            ++count_;
+        }
+        cv_.notify_one();
+    }
+
+    /// Blocks for the next item; false once close()d and empty.
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return done_ || count_ != 0; });
+        if (count_ == 0) return false;
+        item = std::move(ring_[head_]);
+        head_ = (head_ + 1) % ring_.size();
+        --count_;
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    void grow()
+    {
+        vector<T> bigger(std::max<std::size_t>(16, ring_.size() * 2));
+        for (std::size_t i = 0; i < count_; ++i)
+            bigger[i] = std::move(ring_[(head_ + i) % ring_.size()]);
+        ring_.swap(bigger);
+        head_ = 0;
+    }
+
+    vector<T> ring_;
+    std::size_t head_{0};
+    std::size_t count_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_{false};
+};
+
+/* ───────────────────────── request parsing ──────────────────────────── */
+
+void skipSpace(const char*& p)
+{
+    while (*p != '\0' && std::isspace(static_cast<unsigned char>(*p))) ++p;
+}
+
+/// Next whitespace-separated word as [begin, begin + len); false at end.
+bool nextWord(const char*& p, const char*& begin, std::size_t& len)
+{
+    skipSpace(p);
+    begin = p;
+    while (*p != '\0' && !std::isspace(static_cast<unsigned char>(*p))) ++p;
+    len = static_cast<std::size_t>(p - begin);
+    return len != 0;
+}
+
+bool nextInt(const char*& p, int& value)
+{
+    skipSpace(p);
+    char* end = nullptr;
+    errno = 0;
+    const long v = std::strtol(p, &end, 10);
+    if (end == p || errno == ERANGE || v < std::numeric_limits<int>::min() ||
+        v > std::numeric_limits<int>::max()) return false;
+    value = static_cast<int>(v);
+    p = end;
+    return true;
+}
+
+bool nextChar(const char*& p, char& c)
+{
+    skipSpace(p);
+    if (*p == '\0') return false;
+    c = *p++;
+    return true;
+}
+
+bool wordIs(const char* word, std::size_t len, const char* name)
+{
+    return std::strlen(name) == len && std::memcmp(word, name, len) == 0;
+}
+
+/* ───────────────────────── JSON helpers ─────────────────────────────── */
+
+void appendInt(string& out, long long value)
+{
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+void appendError(string& out, const char* msg)
+{
+    out += "{\"ok\":false,\"error\":\"";
+    out += msg;
+    out += "\"}\n";
+}
+
+void appendMove(string& out, const Matrix::Move& mv)
+{
+    out += '[';
+    appendInt(out, mv.first + 1);
+    out += ',';
+    appendInt(out, mv.second + 1);
+    out += ",\"";
+    out += mv.sign;
+    out += "\"]";
+}
+
+void appendMoves(string& out, const vector<Matrix::Move>& moves)
+{
+    out += '[';
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        if (i) out += ',';
+        appendMove(out, moves[i]);
+    }
+    out += ']';
+}
+
+const char* describe(Matrix::MoveStatus status)
+{
+    switch (status) {
+    case Matrix::MoveStatus::OutOfRange:   return "node out of range";
+    case Matrix::MoveStatus::BadSign:      return "sign must be + or -";
+    case Matrix::MoveStatus::Occupied:     return "target cell is occupied";
+    case Matrix::MoveStatus::SignMismatch: return "sign must match existing bound";
+    case Matrix::MoveStatus::Ok:           break;
+    }
+    return "ok";
+}
+
+/* Removes a stale socket left by a dead server.  Refuses anything that is
+   not a socket, and any socket another server is still accepting on. */
+bool clearSocketPath(const sockaddr_un& addr)
+{
+    struct stat st;
+    if (::lstat(addr.sun_path, &st) < 0)
+        return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode)) {
+        std::cerr << addr.sun_path << " exists and is not a socket\n";
+        return false;
+    }
+
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        std::perror("socket");
+        return false;
+    }
+    const bool live =
+        ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(probe);
+    if (live) {
+        std::cerr << "Another server is already listening on "
+                  << addr.sun_path << '\n';
+        return false;
+    }
+    return ::unlink(addr.sun_path) == 0 || errno == ENOENT;
+}
+
+bool setNonBlocking(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+} // namespace
+
+/* ───────────────────────── connection state ─────────────────────────── */
+
+/* The event loop appends complete lines to `queued`; at most one worker
+   drains a connection at a time (`scheduled`), which keeps per-client
+   ordering and lets the worker-side buffers be used without locking.
+   Workers never touch the socket: replies go to `outq`, which only the
+   event loop sends, so a client that stops reading cannot stall a worker.
+   Every buffer here is reused, so a warm connection stops allocating. */
+struct SessionServer::Connection
+{
+    Connection(int fd, int wakeFd, BoardPool& pool)
+        : fd(fd), wakeFd(wakeFd), pool(pool) {}
+
+    ~Connection()
+    {
+        for (auto& [id, board] : sessions) pool.release(board);
+        ::close(fd);
+    }
+
+    Matrix* find(int id) const
+    {
+        for (const auto& [sid, board] : sessions)
+            if (sid == id) return board;
+        return nullptr;
+    }
+
+    /// Lines are waiting and the output backlog leaves room to run them.
+    bool runnable() const
+    {
+        return queuedPos < queued.size() && outq.size() - outPos < kMaxOutput;
+    }
+
+    void wakeLoop() const
+    {
+        const char byte = 0;
+        (void)!::write(wakeFd, &byte, 1);   // a full pipe is awake already
+    }
+
+    /// Every queued line has run and every reply has been sent.
+    bool finished() const
+    {
+        return !scheduled && queuedPos == queued.size() && outPos == outq.size();
+    }
+
+    int fd;                           ///< non-blocking
+    int wakeFd;                       ///< write end of the event-loop pipe
+    BoardPool& pool;
+    string inbuf;                     ///< event-loop side: partial line
+    bool readClosed{false};           ///< event-loop side: peer sent EOF
+
+    std::mutex mutex;                 ///< guards everything down to `scheduled`
+    string queued;                    ///< complete lines not yet run
+    std::size_t queuedPos{0};         ///< first unread byte of `queued`
+    string outq;                      ///< replies not yet sent
+    std::size_t outPos{0};            ///< first unsent byte of `outq`
+    bool scheduled{false};
+
+    /* worker side only */
+    vector<std::pair<int, Matrix*>> sessions;
+    vector<Matrix::Move> moves;       ///< legalMoves() buffer
+    string line;                      ///< current request
+    string out;                       ///< current response
+};
+
+/* ───────────────────────── ctor / event loop ────────────────────────── */
+
+SessionServer::SessionServer(const Options& opts)
+    : opts_(opts), pool_(opts.boards)
+{
+}
+
+int SessionServer::run()
+{
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::perror("socket");
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (opts_.socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << opts_.socketPath << '\n';
+        ::close(listenFd);
+        return 1;
+    }
+    std::strncpy(addr.sun_path, opts_.socketPath.c_str(),
+                 sizeof(addr.sun_path) - 1);
+    if (!clearSocketPath(addr)) {
+        ::close(listenFd);
+        return 1;
+    }
+
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listenFd, SOMAXCONN) < 0) {
+        std::perror("bind/listen");
+        ::close(listenFd);
+        return 1;
+    }
+
+    std::cout << "Serving on " << opts_.socketPath << " ("
+              << opts_.workers << " workers, "
+              << pool_.capacity() << " boards)\n";
+
+    int wake[2];
+    if (::pipe(wake) < 0 || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1])) {
+        std::perror("pipe");
+        ::close(listenFd);
+        return 1;
+    }
+
+    ReadyQueue<std::shared_ptr<Connection>> readyQueue;
+    vector<std::thread> workers;
+    for (unsigned i = 0; i < std::max(1u, opts_.workers); ++i)
+        workers.emplace_back([this, &readyQueue] {
+            std::shared_ptr<Connection> conn;
+            while (readyQueue.pop(conn)) {
+                drain(*conn);
+                conn.reset();
+            }
+        });
+
+    std::map<int, std::shared_ptr<Connection>> conns;
+    vector<pollfd> fds;
+    vector<int> polled;               ///< fds[i + 2] belongs to conns[polled[i]]
+    char buf[kMaxLine];
+
+    /* hand the connection to a worker if it has runnable lines */
+    auto schedule = [&readyQueue](const std::shared_ptr<Connection>& conn) {
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if (conn->scheduled || !conn->runnable()) return;
+            conn->scheduled = true;
+        }
+        readyQueue.push(conn);
+    };
+
+    /* send what the socket takes; false if the peer is gone */
+    auto flush = [](Connection& conn) {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        while (conn.outPos < conn.outq.size()) {
+            const ssize_t n = ::send(conn.fd, conn.outq.data() + conn.outPos,
+                                     conn.outq.size() - conn.outPos, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (n <= 0) return false;
+            conn.outPos += static_cast<std::size_t>(n);
+        }
+        conn.outq.clear();
+        conn.outPos = 0;
+        return true;
+    };
+
+    /* append complete lines to the worker queue and schedule them */
+    auto enqueue = [&schedule](const std::shared_ptr<Connection>& conn, std::size_t end) {
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->queued.erase(0, conn->queuedPos);
+            conn->queuedPos = 0;
+            conn->queued.append(conn->inbuf, 0, end);
+        }
+        conn->inbuf.erase(0, end);
+        schedule(conn);
+    };
+
+    /* workers may still hold a ref; shutdown() tells the client now */
+    auto drop = [&conns](std::map<int, std::shared_ptr<Connection>>::iterator it) {
+        ::shutdown(it->second->fd, SHUT_RDWR);
+        conns.erase(it);
+    };
+
+    while (!stop_.load()) {
+        fds.clear();
+        polled.clear();
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({wake[0], POLLIN, 0});
+        for (auto& [fd, conn] : conns) {
+            short events = 0;
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (!conn->readClosed &&
+                    conn->queued.size() - conn->queuedPos < kMaxQueued &&
+                    conn->outq.size() - conn->outPos < kMaxOutput)
+                    events |= POLLIN;            // else let the client block
+                if (conn->outPos < conn->outq.size())
+                    events |= POLLOUT;
+            }
+            /* a read-closed peer reports POLLHUP on every poll; leave it out
+               until there is output, the wake pipe signals new replies */
+            fds.push_back({events ? fd : -1, events, 0});
+            polled.push_back(fd);
+        }
+
+        const int ready = ::poll(fds.data(), fds.size(), kPollMs);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::perror("poll");
+            break;
+        }
+        if (ready == 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            const int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd >= 0 && setNonBlocking(fd))
+                conns.emplace(fd, std::make_shared<Connection>(fd, wake[1], pool_));
+            else if (fd >= 0)
+                ::close(fd);
+        }
+        if (fds[1].revents & POLLIN)
+            while (::read(wake[0], buf, sizeof(buf)) > 0) {}
+
+        for (std::size_t i = 2; i < fds.size(); ++i) {
+            auto it = conns.find(polled[i - 2]);
+            std::shared_ptr<Connection> conn = it->second;
+
+            /* new output since the poll set was built is signalled through
+               the wake pipe, so try every connection with a backlog */
+            if ((fds[i].events & POLLOUT) || fds[1].revents) {
+                if (!flush(*conn)) {
+                    drop(it);
+                    continue;
+                }
+                schedule(conn);     // may have been paused on kMaxOutput
+            }
+
+            /* after EOF, hold the connection until its replies are out */
+            if (conn->readClosed) {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->finished()) {
+                    drop(it);
+                    continue;
+                }
+            }
+
+            const short rev = fds[i].revents;
+            if (rev & (POLLERR | POLLNVAL)) {
+                drop(it);
+                continue;
+            }
+            if (conn->readClosed || !(rev & (POLLIN | POLLHUP))) continue;
+
+            const ssize_t n = ::recv(conn->fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                continue;
+            if (n < 0) {
+                drop(it);
+                continue;
+            }
+            if (n == 0) {
+                /* half-close: run what was sent, a last unterminated line
+                   included, and drop once everything has been flushed */
+                conn->readClosed = true;
+                if (!conn->inbuf.empty()) {
+                    conn->inbuf += '\n';
+                    enqueue(conn, conn->inbuf.size());
+                }
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->finished()) drop(it);
+                continue;
+            }
+            conn->inbuf.append(buf, static_cast<std::size_t>(n));
+
+            const std::size_t last = conn->inbuf.rfind('\n');
+            if (last != string::npos) enqueue(conn, last + 1);
+            if (conn->inbuf.size() > kMaxLine) drop(it);
+        }
+    }
+
+    readyQueue.close();
+    for (auto& t : workers) t.join();
+    conns.clear();
+    ::close(wake[0]);
+    ::close(wake[1]);
+    ::close(listenFd);
+    ::unlink(opts_.socketPath.c_str());
+    return 0;
+}
+
+/* Runs queued lines until none are left or the unsent output reaches
+   kMaxOutput; in the latter case the event loop reschedules once it has
+   flushed enough. */
+void SessionServer::drain(Connection& conn)
+{
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            if (!conn.runnable()) {
+                if (conn.queuedPos == conn.queued.size()) {
+                    conn.queued.clear();
+                    conn.queuedPos = 0;
+                }
+                conn.scheduled = false;
+                /* the loop may be waiting on this to finish a read-closed
+                   connection or to resume one paused on kMaxOutput */
+                conn.wakeLoop();
+                return;
+            }
+            const std::size_t nl = conn.queued.find('\n', conn.queuedPos);
+            conn.line.assign(conn.queued, conn.queuedPos, nl - conn.queuedPos);
+            conn.queuedPos = nl + 1;    // only whole lines are queued
+        }
+
+        conn.out.clear();
+        handleLine(conn, conn.line.c_str(), conn.out);
+
+        bool wasIdle;
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            wasIdle = conn.outPos == conn.outq.size();
+            if (conn.outPos != 0 && conn.outPos * 2 >= conn.outq.size()) {
+                conn.outq.erase(0, conn.outPos);
+                conn.outPos = 0;
+            }
+            conn.outq += conn.out;
+        }
+        /* an idle connection is not polled for POLLOUT; nudge the loop */
+        if (wasIdle) conn.wakeLoop();
+    }
+}
+
+/* ───────────────────────── request dispatch ─────────────────────────── */
+
+void SessionServer::handleLine(Connection& conn, const char* line, string& out)
+{
+    const char* p = line;
+    const char* cmd;
+    std::size_t len;
+    if (!nextWord(p, cmd, len)) return appendError(out, "empty request");
+
+    if (wordIs(cmd, len, "create")) {
+        int n;
+        if (!nextInt(p, n)) return appendError(out, "usage: create N");
+        if (n < 4 || n > opts_.maxSticks)
+            return appendError(out, "stick count out of range");
+
+        Matrix* board = pool_.acquire(n);
+        if (board == nullptr) return appendError(out, "no free boards");
+
+        const int id = nextSession_.fetch_add(1);
+        conn.sessions.emplace_back(id, board);
+        out += "{\"ok\":true,\"session\":";
+        appendInt(out, id);
+        out += ",\"size\":";
+        appendInt(out, board->size());
+        out += "}\n";
+        return;
+    }
+
+    const bool isMove = wordIs(cmd, len, "move");
+    const bool isUndo = wordIs(cmd, len, "undo");
+    const bool isLegal = wordIs(cmd, len, "legal");
+    const bool isSnapshot = wordIs(cmd, len, "snapshot");
+    const bool isClose = wordIs(cmd, len, "close");
+    if (!isMove && !isUndo && !isLegal && !isSnapshot && !isClose)
+        return appendError(out, "unknown command");
+
+    int id;
+    if (!nextInt(p, id)) return appendError(out, "missing session id");
+    Matrix* found = conn.find(id);
+    if (found == nullptr) return appendError(out, "unknown session");
+    Matrix& board = *found;
+
+    if (isMove) {
+        int a, b;
+        char sign;
+        if (!nextInt(p, a) || !nextInt(p, b) || !nextChar(p, sign))
+            return appendError(out, "usage: move ID A B S");
+
+        const Matrix::MoveStatus status = board.applyMove(a - 1, b - 1, sign);
+        if (status != Matrix::MoveStatus::Ok) return appendError(out, describe(status));
+
+        out += "{\"ok\":true,\"eliminated\":";
+        appendInt(out, board.lastEliminated());
+        out += ",\"full\":";
+        out += board.isFull() ? "true" : "false";
+        out += "}\n";
+    } else if (isUndo) {
+        if (!board.undo()) return appendError(out, "nothing to undo");
+        out += "{\"ok\":true,\"moves\":";
+        appendInt(out, static_cast<long long>(board.history().size()));
+        out += "}\n";
+    } else if (isLegal) {
+        board.legalMoves(conn.moves);
+        out += "{\"ok\":true,\"moves\":";
+        appendMoves(out, conn.moves);
+        out += "}\n";
+    } else if (isSnapshot) {
+        out += "{\"ok\":true,\"size\":";
+        appendInt(out, board.size());
+        out += ",\"history\":";
+        appendMoves(out, board.history());
+        out += ",\"rows\":[";
+        const auto& cells = board.cells();
+        for (int r = 0; r < board.size(); ++r) {
+            out += r ? ",\"" : "\"";
+            for (int c = 0; c < board.size(); ++c) {
+                if (c) out += ' ';
+                out += cells[r][c];
+            }
+            out += '"';
+        }
+        out += "]}\n";
+    } else {
+        pool_.release(&board);
+        auto it = std::find_if(conn.sessions.begin(), conn.sessions.end(),
+                               [id](const auto& s) { return s.first == id; });
+        conn.sessions.erase(it);
+        out += "{\"ok\":true}\n";
+    }
+}
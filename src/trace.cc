@@ -0,0 +1,295 @@
+/******************************************************************************
+ * trace.cc  —  per-thread rings and the background trace writer
+ ******************************************************************************/
+
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Trace {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+/* ───────────────────────── SPSC ring ────────────────────────────────── */
+
+/* The owning thread is the only producer and the writer thread the only
+   consumer, so head / tail need nothing stronger than acquire / release. */
+struct Ring {
+    explicit Ring(std::size_t cap)
+        : capacity(cap), mask(cap - 1), highWater(cap / 2), buf(new Event[cap]) {}
+
+    const std::size_t capacity;                     ///< power of two
+    const std::size_t mask;
+    const std::size_t highWater;                    ///< wake the writer here
+    alignas(64) std::atomic<std::size_t> head{0};   ///< producer side
+    alignas(64) std::atomic<std::size_t> tail{0};   ///< consumer side
+    std::unique_ptr<Event[]> buf;
+};
+
+std::mutex g_registryMutex;
+std::vector<std::shared_ptr<Ring>> g_rings;   ///< never shrinks
+thread_local Ring* t_ring = nullptr;
+
+std::atomic<std::size_t> g_ringCapacity{1u << 16};
+std::atomic<bool> g_lossless{true};
+std::atomic<bool> g_writerRunning{false};
+std::atomic<bool> g_kick{false};              ///< a ring passed highWater
+
+std::atomic<std::uint64_t> g_written{0};
+std::atomic<std::uint64_t> g_dropped{0};
+std::atomic<std::uint64_t> g_stalls{0};       ///< lossless waits for space
+std::atomic<std::uint32_t> g_nextBoard{1};
+
+/* writer state; g_file / g_writer are guarded by g_sessionMutex,
+   g_stopWriter by g_wakeMutex */
+std::mutex g_sessionMutex;
+std::FILE* g_file = nullptr;
+std::thread g_writer;
+std::mutex g_wakeMutex;
+std::condition_variable g_wake;
+bool g_stopWriter = false;
+
+constexpr auto kFlushInterval = std::chrono::milliseconds(5);
+
+Ring* threadRing()
+{
+    auto ring = std::make_shared<Ring>(g_ringCapacity.load());
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    g_rings.push_back(ring);
+    t_ring = ring.get();
+    return t_ring;
+}
+
+void drain(Ring& ring, std::FILE* out)
+{
+    const std::size_t tail = ring.tail.load(std::memory_order_relaxed);
+    const std::size_t head = ring.head.load(std::memory_order_acquire);
+    if (head == tail) return;
+
+    const std::size_t first = tail & ring.mask;
+    const std::size_t count = head - tail;
+    const std::size_t run = std::min(count, ring.capacity - first);
+    std::fwrite(ring.buf.get() + first, sizeof(Event), run, out);
+    std::fwrite(ring.buf.get(), sizeof(Event), count - run, out);
+
+    ring.tail.store(head, std::memory_order_release);
+    g_written.fetch_add(count, std::memory_order_relaxed);
+}
+
+void drainAll(std::FILE* out)
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        rings = g_rings;
+    }
+    for (auto& ring : rings) drain(*ring, out);
+    std::fflush(out);   // a killed process still leaves a readable file
+}
+
+/* Called from the hot path without g_wakeMutex: a wake-up lost to the
+   race with wait_for() costs at most one kFlushInterval. */
+void kickWriter()
+{
+    g_kick.store(true, std::memory_order_relaxed);
+    g_wake.notify_one();
+}
+
+void writerLoop(std::FILE* out)
+{
+    std::unique_lock<std::mutex> lock(g_wakeMutex);
+    while (!g_stopWriter) {
+        g_wake.wait_for(lock, kFlushInterval, [] {
+            return g_stopWriter || g_kick.load(std::memory_order_relaxed);
+        });
+        g_kick.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        drainAll(out);
+        lock.lock();
+    }
+}
+
+/* Lossless mode: yield until the writer frees a slot.  Gives up (and the
+   caller drops) only when the writer has gone away during stop(). */
+bool waitForSpace(Ring& ring, std::size_t head, std::size_t& used)
+{
+    if (!g_lossless.load(std::memory_order_relaxed)) return false;
+
+    g_stalls.fetch_add(1, std::memory_order_relaxed);
+    kickWriter();
+    while ((used = head - ring.tail.load(std::memory_order_acquire)) == ring.capacity) {
+        if (!g_writerRunning.load(std::memory_order_acquire)) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+/* ───────────────────────── session control ──────────────────────────── */
+
+bool start(const std::string& path, const Options& opts)
+{
+    std::lock_guard<std::mutex> session(g_sessionMutex);
+    if (g_file != nullptr) return false;
+
+    g_file = std::fopen(path.c_str(), "wb");
+    if (g_file == nullptr) return false;
+
+    Header header{};
+    std::memcpy(header.magic, "SBTRACE1", sizeof(header.magic));
+    header.version = kVersion;
+    header.eventSize = sizeof(Event);
+    std::fwrite(&header, sizeof(header), 1, g_file);
+    std::fflush(g_file);
+
+    /* clamp first so the doubling below cannot overflow */
+    const std::size_t want = std::min(opts.ringCapacity, kMaxRingCapacity);
+    std::size_t cap = 1024;
+    while (cap < want) cap <<= 1;
+    g_ringCapacity.store(cap);
+    g_lossless.store(opts.mode == Mode::Lossless);
+
+    /* no writer runs between sessions, so we are the consumer here; drop
+       whatever landed after the last session's final drain */
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        for (auto& ring : g_rings)
+            ring->tail.store(ring->head.load(std::memory_order_acquire),
+                             std::memory_order_release);
+    }
+
+    g_written.store(0);
+    g_dropped.store(0);
+    g_stalls.store(0);
+    g_stopWriter = false;
+    g_writerRunning.store(true);
+    g_writer = std::thread(writerLoop, g_file);
+    g_enabled.store(true);
+    return true;
+}
+
+/* Producers that read g_enabled just before it flips may still land an
+   event after the final drain; it stays in the ring until the next
+   start() discards it. */
+void stop()
+{
+    std::lock_guard<std::mutex> session(g_sessionMutex);
+    if (g_file == nullptr) return;
+
+    g_enabled.store(false);
+    {
+        std::lock_guard<std::mutex> lock(g_wakeMutex);
+        g_stopWriter = true;
+    }
+    g_wake.notify_all();
+    g_writer.join();
+    drainAll(g_file);
+    g_writerRunning.store(false);
+
+    Header header{};
+    std::memcpy(header.magic, "SBTRACE1", sizeof(header.magic));
+    header.version = kVersion;
+    header.eventSize = sizeof(Event);
+    header.dropped = g_dropped.load();
+    std::fseek(g_file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, g_file);
+
+    std::fclose(g_file);
+    g_file = nullptr;
+
+    const std::uint64_t written = g_written.load();
+    const std::uint64_t dropped = header.dropped;
+    const std::uint64_t total = written + dropped;
+    std::fprintf(stderr,
+                 "Trace: %llu events written, %llu dropped (%.2f%%), "
+                 "%llu stalls on a full ring\n",
+                 static_cast<unsigned long long>(written),
+                 static_cast<unsigned long long>(dropped),
+                 total ? 100.0 * static_cast<double>(dropped) / static_cast<double>(total) : 0.0,
+                 static_cast<unsigned long long>(g_stalls.load()));
+}
+
+/* ───────────────────────── recording ────────────────────────────────── */
+
+void record(Context& ctx, int row, int col, Cell from, Cell to)
+{
+    Ring* ring = t_ring ? t_ring : threadRing();
+    const std::uint32_t seq = ctx.seq++;
+
+    const std::size_t head = ring->head.load(std::memory_order_relaxed);
+    std::size_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (used == ring->capacity && !waitForSpace(*ring, head, used)) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;   // the gap in `seq` marks the loss
+    }
+
+    ring->buf[head & ring->mask] = Event{
+        ctx.board, seq, ctx.move,
+        static_cast<std::uint16_t>(row), static_cast<std::uint16_t>(col),
+        from, to, ctx.rule, ctx.flags};
+    ring->head.store(head + 1, std::memory_order_release);
+
+    if (used + 1 == ring->highWater) kickWriter();
+}
+
+std::uint32_t nextBoardId()
+{
+    return g_nextBoard.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* ───────────────────────── encoding ─────────────────────────────────── */
+
+Cell encode(const std::string& cell)
+{
+    /* every legal cell is one character except "-1" */
+    if (cell.size() == 2) return cell == "-1" ? Cell::Neg : Cell::Unknown;
+    if (cell.size() != 1) return Cell::Unknown;
+    switch (cell[0]) {
+    case '0': return Cell::Empty;
+    case '1': return Cell::Pos;
+    case '2': return Cell::Strong;
+    case 'x': return Cell::Blocked;
+    case '+': return Cell::BoundPos;
+    case '-': return Cell::BoundNeg;
+    default:  return Cell::Unknown;
+    }
+}
+
+const char* decode(Cell cell)
+{
+    switch (cell) {
+    case Cell::Empty:    return "0";
+    case Cell::Pos:      return "1";
+    case Cell::Neg:      return "-1";
+    case Cell::Strong:   return "2";
+    case Cell::Blocked:  return "x";
+    case Cell::BoundPos: return "+";
+    case Cell::BoundNeg: return "-";
+    case Cell::Unknown:  break;
+    }
+    return "?";
+}
+
+const char* name(Rule rule)
+{
+    switch (rule) {
+    case Rule::None:              return "none";
+    case Rule::DirectedSign:      return "applyDirectedSign";
+    case Rule::EdgeTypeRules:     return "applyEdgeTypeRules";
+    case Rule::EnforceConnection: return "enforceConnection";
+    case Rule::ConnectionLimit:   return "applyConnectionLimit";
+    }
+    return "?";
+}
+
+} // namespace Trace